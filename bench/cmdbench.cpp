@@ -0,0 +1,132 @@
+// Command buffer benchmark: record time scaling across worker threads, and replay cost per command.
+// Build against the engine sources, e.g.
+//   g++ -std=c++11 -O2 -DAGE_EXPORTS bench/cmdbench.cpp src/*.cpp -lglew32 -lopengl32 -lgdi32 -o cmdbench
+
+#include "../src/include/age.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#define BENCH_COMMANDS 1000000
+#define BENCH_RUNS 5
+// arena bytes per draw with 8 byte aligned payloads: 8 + 8 + (16 + 64) + 8
+#define BENCH_DRAW_BYTES 104
+#define BENCH_SLACK 4096
+
+static const float matrix[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+// one draw is four commands: shader, texture, uniform and mesh
+static void Record(age::rp::CommandBuffer* buffer, uint32_t first, uint32_t draws, GLuint program, GLuint texture, GLuint vao)
+{
+	buffer->Reset();
+	for (uint32_t i = first; i < first + draws; i++)
+	{
+		// scatter the keys so Sort has real work to do
+		uint64_t key = ((uint64_t)(i * 2654435761u) << 32) | i;
+		buffer->BindShader(key, program);
+		buffer->BindTexture(key, 0, texture);
+		buffer->SetUniform(key, program, 0, GL_FLOAT_MAT4, 1, matrix);
+		buffer->DrawMesh(key, vao, 6);
+	}
+	buffer->Sort();
+}
+
+// each worker records BENCH_COMMANDS / threads commands, so only that much is reserved per buffer
+static void CreateBuffers(std::vector<age::rp::CommandBuffer*>& buffers, size_t threads)
+{
+	for (size_t t = 0; t < buffers.size(); t++) delete buffers[t];
+	buffers.clear();
+	size_t draws = BENCH_COMMANDS / 4 / threads + 1;
+	for (size_t t = 0; t < threads; t++) buffers.push_back(new age::rp::CommandBuffer((uint32_t)(draws * 4), draws * BENCH_DRAW_BYTES + BENCH_SLACK));
+}
+
+static double RecordParallel(std::vector<age::rp::CommandBuffer*>& buffers, size_t threads, GLuint program, GLuint texture, GLuint vao)
+{
+	uint32_t draws = BENCH_COMMANDS / 4 / threads;
+	std::vector<std::thread> workers;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (size_t t = 0; t < threads; t++)
+	{
+		workers.push_back(std::thread(Record, buffers[t], (uint32_t)(t * draws), draws, program, texture, vao));
+	}
+	for (size_t t = 0; t < threads; t++)
+	{
+		workers[t].join();
+		if (buffers[t]->HasOverflowed()) printf("  buffer %zu overflowed\n", t);
+	}
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+	size_t maxThreads = std::thread::hardware_concurrency();
+	if (maxThreads == 0) maxThreads = 4;
+	std::vector<age::rp::CommandBuffer*> buffers;
+
+	// recording only stores GL names, so this half runs without a context
+	printf("record + sort, %d commands\n", BENCH_COMMANDS);
+	double single = 0;
+	// double the workers each step and always finish on the full hardware concurrency
+	for (size_t threads = 1; threads <= maxThreads; threads = threads < maxThreads && threads * 2 > maxThreads ? maxThreads : threads * 2)
+	{
+		CreateBuffers(buffers, threads);
+		double best = 0;
+		for (int run = 0; run < BENCH_RUNS; run++)
+		{
+			double ms = RecordParallel(buffers, threads, 1, 1, 1);
+			if (run == 0 || ms < best) best = ms;
+		}
+		if (threads == 1) single = best;
+		printf("  %2zu threads: %8.3f ms  %6.2f ns/command  %5.2fx\n", threads, best, best * 1e6 / BENCH_COMMANDS, single / best);
+	}
+
+	// replay needs real GL objects and a current context
+	age::wnd::Window* window = age::wnd::Init() == 0 ? new age::wnd::Window("cmdbench", 0, 0, 256, 256) : NULL;
+	if (window == NULL || window->MakeContextCurrent() != GLEW_OK)
+	{
+		printf("replay skipped: no GL context\n");
+		for (size_t t = 0; t < buffers.size(); t++) delete buffers[t];
+		return 1;
+	}
+
+	const char* vertexSource = "#version 450\nlayout(location = 0) in vec2 position;\nlayout(location = 0) uniform mat4 transform;\nvoid main() { gl_Position = transform * vec4(position, 0.0, 1.0); }\n";
+	const char* fragmentSource = "#version 450\nlayout(binding = 0) uniform sampler2D image;\nout vec4 color;\nvoid main() { color = texture(image, vec2(0.5)); }\n";
+	GLuint shaders[2];
+	shaders[0] = age::rp::Shader::CreateShader(GL_VERTEX_SHADER, std::string(vertexSource));
+	shaders[1] = age::rp::Shader::CreateShader(GL_FRAGMENT_SHADER, std::string(fragmentSource));
+	age::rp::Shader* program = new age::rp::Shader(2, shaders);
+	float positions[8] = { 0, 0, 0, 0.01f, 0.01f, 0.01f, 0.01f, 0 };
+	uint indices[6] = { 0, 1, 2, 2, 3, 0 };
+	age::rp::GLBuffer* vbo = new age::rp::GLBuffer(2, 8, positions, 0);
+	age::rp::GLBuffer* vbos[1] = { vbo };
+	age::rp::Mesh* mesh = new age::rp::Mesh(1, vbos, 6, indices);
+	age::rp::Texture* texture = new age::rp::Texture(1, 1, 1, GL_RGBA8, GL_NEAREST, GL_REPEAT);
+
+	size_t threads = maxThreads;
+	CreateBuffers(buffers, threads);
+	RecordParallel(buffers, threads, program->GetId(), texture->GetId(), mesh->GetId());
+	printf("replay, %d commands merged from %zu buffers\n", BENCH_COMMANDS, threads);
+	double best = 0;
+	for (int run = 0; run < BENCH_RUNS; run++)
+	{
+		glFinish();
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		age::rp::CommandBuffer::Submit(threads, buffers.data());
+		double submit = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		glFinish();
+		if (run == 0 || submit < best) best = submit;
+	}
+	printf("  cpu submit: %8.3f ms  %6.2f ns/command\n", best, best * 1e6 / BENCH_COMMANDS);
+
+	delete texture;
+	delete mesh;
+	delete vbo;
+	delete program;
+	age::rp::Shader::DeleteShader(shaders[0]);
+	age::rp::Shader::DeleteShader(shaders[1]);
+	for (size_t t = 0; t < buffers.size(); t++) delete buffers[t];
+	delete window;
+	return 0;
+}
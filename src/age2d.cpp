@@ -0,0 +1,400 @@
+#include "include/age2d.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <windows.h>
+
+namespace age
+{
+	namespace rp
+	{
+		static const char* spriteVertexSource =
+			"#version 450\n"
+			"layout(location = 0) in vec2 position;\n"
+			"layout(location = 1) in vec2 uv;\n"
+			"layout(location = 2) in vec4 color;\n"
+			"layout(location = 0) uniform mat4 projection;\n"
+			"out vec2 vUv;\n"
+			"out vec4 vColor;\n"
+			"void main()\n"
+			"{\n"
+			"	vUv = uv;\n"
+			"	vColor = color;\n"
+			"	gl_Position = projection * vec4(position, 0.0, 1.0);\n"
+			"}\n";
+
+		static const char* spriteFragmentSource =
+			"#version 450\n"
+			"layout(binding = 0) uniform sampler2D image;\n"
+			"in vec2 vUv;\n"
+			"in vec4 vColor;\n"
+			"out vec4 color;\n"
+			"void main()\n"
+			"{\n"
+			"	color = texture(image, vUv) * vColor;\n"
+			"}\n";
+
+		static uint DecodeUTF8(const std::string& text, size_t& i)
+		{
+			unsigned char c = text[i++];
+			int extra = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : 0;
+			uint codepoint = extra == 0 ? c : c & (0x3F >> extra);
+			for (; extra > 0 && i < text.length(); extra--) codepoint = (codepoint << 6) | (text[i++] & 0x3F);
+			return codepoint;
+		}
+
+		Font::Font(std::string file, std::string face, int size, int atlasSize)
+		{
+			this->file = file;
+			this->atlasSize = atlasSize;
+			this->penX = 1;
+			this->penY = 1;
+			this->rowHeight = 0;
+			this->full = false;
+			AddFontResourceExA(file.c_str(), FR_PRIVATE, 0);
+			this->dc = CreateCompatibleDC(NULL);
+			this->font = CreateFontA(-size, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE, DEFAULT_CHARSET, OUT_TT_PRECIS, CLIP_DEFAULT_PRECIS, ANTIALIASED_QUALITY, DEFAULT_PITCH | FF_DONTCARE, face.c_str());
+			SelectObject((HDC)(this->dc), (HFONT)(this->font));
+			TEXTMETRICA metrics;
+			GetTextMetricsA((HDC)(this->dc), &metrics);
+			this->ascent = metrics.tmAscent;
+			this->lineHeight = metrics.tmHeight + metrics.tmExternalLeading;
+
+			// single channel atlas, swizzled so it samples as white with coverage in alpha
+			this->atlas = new Texture(atlasSize, atlasSize, 1, GL_R8, GL_LINEAR, GL_CLAMP_TO_EDGE);
+			GLint swizzle[4] = { GL_ONE, GL_ONE, GL_ONE, GL_RED };
+			glTextureParameteriv(this->atlas->GetId(), GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+			glClearTexImage(this->atlas->GetId(), 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+		}
+		Font::~Font()
+		{
+			delete this->atlas;
+			DeleteDC((HDC)(this->dc));
+			DeleteObject((HFONT)(this->font));
+			RemoveFontResourceExA(this->file.c_str(), FR_PRIVATE, 0);
+		}
+		bool Font::Rasterize(uint codepoint, Glyph& glyph)
+		{
+			GLYPHMETRICS metrics;
+			MAT2 identity = { { 0, 1 }, { 0, 0 }, { 0, 0 }, { 0, 1 } };
+			DWORD bytes = GetGlyphOutlineW((HDC)(this->dc), codepoint, GGO_GRAY8_BITMAP, &metrics, 0, NULL, &identity);
+			if (bytes == GDI_ERROR) return false;
+			glyph.advance = metrics.gmCellIncX;
+			glyph.offsetX = metrics.gmptGlyphOrigin.x;
+			glyph.offsetY = this->ascent - metrics.gmptGlyphOrigin.y;
+			glyph.width = 0;
+			glyph.height = 0;
+			glyph.u0 = glyph.v0 = glyph.u1 = glyph.v1 = 0;
+			if (bytes == 0) return true;
+
+			int width = metrics.gmBlackBoxX;
+			int height = metrics.gmBlackBoxY;
+			int pitch = (width + 3) & ~3;
+			if (width + 2 > this->atlasSize)
+			{
+				// wider than an empty shelf, it would never fit
+				this->full = true;
+				return false;
+			}
+			this->raster.resize(bytes);
+			GetGlyphOutlineW((HDC)(this->dc), codepoint, GGO_GRAY8_BITMAP, &metrics, bytes, this->raster.data(), &identity);
+
+			// shelf packing with a one texel gap between glyphs
+			if (this->penX + width + 1 > this->atlasSize)
+			{
+				this->penX = 1;
+				this->penY += this->rowHeight + 1;
+				this->rowHeight = 0;
+			}
+			if (this->penY + height + 1 > this->atlasSize)
+			{
+				// keep the advance so layout stays stable, the glyph itself is left blank
+				this->full = true;
+				return false;
+			}
+
+			// GGO_GRAY8_BITMAP has 65 coverage levels in DWORD aligned rows
+			this->pixels.resize(width * height);
+			for (int y = 0; y < height; y++)
+			{
+				for (int x = 0; x < width; x++)
+				{
+					uint value = this->raster[y * pitch + x] * 255 / 64;
+					this->pixels[y * width + x] = value > 255 ? 255 : value;
+				}
+			}
+			GLint alignment;
+			glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			this->atlas->SetData2D(0, this->penX, this->penY, width, height, GL_RED, GL_UNSIGNED_BYTE, this->pixels.data());
+			glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+
+			glyph.width = width;
+			glyph.height = height;
+			glyph.u0 = (float)(this->penX) / this->atlasSize;
+			glyph.v0 = (float)(this->penY) / this->atlasSize;
+			glyph.u1 = (float)(this->penX + width) / this->atlasSize;
+			glyph.v1 = (float)(this->penY + height) / this->atlasSize;
+			this->penX += width + 1;
+			if (height > this->rowHeight) this->rowHeight = height;
+			return true;
+		}
+		const Glyph* Font::GetGlyph(uint codepoint)
+		{
+			// GetGlyphOutlineW takes a single UTF-16 unit, anything outside the BMP becomes U+FFFD
+			if (codepoint > 0xFFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF)) codepoint = 0xFFFD;
+			std::unordered_map<uint, Glyph>::iterator it = this->glyphs.find(codepoint);
+			if (it != this->glyphs.end()) return &it->second;
+			// failures are cached as blank glyphs so they are not rasterized again every frame
+			Glyph glyph = { 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+			this->Rasterize(codepoint, glyph);
+			return &(this->glyphs[codepoint] = glyph);
+		}
+		bool Font::IsAtlasFull()
+		{
+			return this->full;
+		}
+		void Font::ClearAtlas()
+		{
+			this->glyphs.clear();
+			this->penX = 1;
+			this->penY = 1;
+			this->rowHeight = 0;
+			this->full = false;
+			glClearTexImage(this->atlas->GetId(), 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+		}
+		Texture* Font::GetAtlas()
+		{
+			return this->atlas;
+		}
+		int Font::GetAscent()
+		{
+			return this->ascent;
+		}
+		int Font::GetLineHeight()
+		{
+			return this->lineHeight;
+		}
+
+		SpriteBatch::SpriteBatch(size_t maxQuads)
+		{
+			this->maxQuads = maxQuads;
+			this->cursor = 0;
+			this->drawCalls = 0;
+			this->order = PAINTER_ORDER;
+			this->quads.reserve(maxQuads);
+			this->staging.reserve(maxQuads * 4);
+
+			this->vertices = new GLBuffer(BufSize(1, maxQuads * 4 * AGE_SPRITE_BUFFER_FRAMES, sizeof(SpriteVertex)), GL_FLOAT, NULL, GL_DYNAMIC_STORAGE_BIT);
+			std::vector<uint> pattern(maxQuads * 6);
+			for (size_t i = 0; i < maxQuads; i++)
+			{
+				uint base = i * 4;
+				pattern[i * 6 + 0] = base + 0;
+				pattern[i * 6 + 1] = base + 1;
+				pattern[i * 6 + 2] = base + 2;
+				pattern[i * 6 + 3] = base + 2;
+				pattern[i * 6 + 4] = base + 3;
+				pattern[i * 6 + 5] = base + 0;
+			}
+			this->indices = new GLBuffer(6, pattern.size(), pattern.data(), 0);
+
+			glCreateVertexArrays(1, &this->vao);
+			glVertexArrayVertexBuffer(this->vao, 0, this->vertices->GetId(), 0, sizeof(SpriteVertex));
+			glVertexArrayElementBuffer(this->vao, this->indices->GetId());
+			glEnableVertexArrayAttrib(this->vao, 0);
+			glVertexArrayAttribBinding(this->vao, 0, 0);
+			glVertexArrayAttribFormat(this->vao, 0, 2, GL_FLOAT, GL_FALSE, offsetof(SpriteVertex, x));
+			glEnableVertexArrayAttrib(this->vao, 1);
+			glVertexArrayAttribBinding(this->vao, 1, 0);
+			glVertexArrayAttribFormat(this->vao, 1, 2, GL_FLOAT, GL_FALSE, offsetof(SpriteVertex, u));
+			glEnableVertexArrayAttrib(this->vao, 2);
+			glVertexArrayAttribBinding(this->vao, 2, 0);
+			glVertexArrayAttribFormat(this->vao, 2, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(SpriteVertex, color));
+
+			GLuint shaders[2];
+			shaders[0] = Shader::CreateShader(GL_VERTEX_SHADER, std::string(spriteVertexSource));
+			shaders[1] = Shader::CreateShader(GL_FRAGMENT_SHADER, std::string(spriteFragmentSource));
+			this->defaultShader = new Shader(2, shaders);
+			Shader::DeleteShader(shaders[0]);
+			Shader::DeleteShader(shaders[1]);
+			this->shader = this->defaultShader;
+
+			uint32_t white = 0xFFFFFFFF;
+			this->white = new Texture(1, 1, 1, GL_RGBA8, GL_NEAREST, GL_REPEAT);
+			this->white->SetData2D(0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, &white);
+		}
+		SpriteBatch::~SpriteBatch()
+		{
+			glDeleteVertexArrays(1, &this->vao);
+			delete this->vertices;
+			delete this->indices;
+			delete this->defaultShader;
+			delete this->white;
+		}
+		void SpriteBatch::Begin(int width, int height, SpriteOrder order)
+		{
+			this->order = order;
+			this->drawCalls = 0;
+			this->shader = this->defaultShader;
+			for (int i = 0; i < 16; i++) this->projection[i] = 0;
+			this->projection[0] = 2.0f / width;
+			this->projection[5] = -2.0f / height;
+			this->projection[10] = 1;
+			this->projection[12] = -1;
+			this->projection[13] = 1;
+			this->projection[15] = 1;
+			// quads are ordered on the CPU, so nothing from the 3D pass may reject or cull them
+			this->depthTest = glIsEnabled(GL_DEPTH_TEST);
+			this->cullFace = glIsEnabled(GL_CULL_FACE);
+			this->blend = glIsEnabled(GL_BLEND);
+			glGetIntegerv(GL_BLEND_SRC_RGB, &this->blendFunc[0]);
+			glGetIntegerv(GL_BLEND_DST_RGB, &this->blendFunc[1]);
+			glGetIntegerv(GL_BLEND_SRC_ALPHA, &this->blendFunc[2]);
+			glGetIntegerv(GL_BLEND_DST_ALPHA, &this->blendFunc[3]);
+			glDisable(GL_DEPTH_TEST);
+			glDisable(GL_CULL_FACE);
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		}
+		void SpriteBatch::End()
+		{
+			this->Flush();
+			// hand the state back as Begin found it
+			if (this->depthTest) glEnable(GL_DEPTH_TEST);
+			if (this->cullFace) glEnable(GL_CULL_FACE);
+			if (!(this->blend)) glDisable(GL_BLEND);
+			glBlendFuncSeparate(this->blendFunc[0], this->blendFunc[1], this->blendFunc[2], this->blendFunc[3]);
+		}
+		void SpriteBatch::Flush()
+		{
+			size_t count = this->quads.size();
+			if (count == 0) return;
+			if (this->order == DEPTH_ORDER)
+			{
+				// back to front, equal depths grouped by state to keep runs long
+				std::stable_sort(this->quads.begin(), this->quads.end(), [](const Quad& a, const Quad& b) {
+					if (a.depth != b.depth) return a.depth > b.depth;
+					if (a.shader != b.shader) return a.shader < b.shader;
+					return a.texture < b.texture;
+				});
+			}
+
+			// the index pattern covers maxQuads, so a sorted list that grew past it is drawn in chunks
+			glBindVertexArray(this->vao);
+			Shader* bound = NULL;
+			for (size_t first = 0; first < count; first += this->maxQuads)
+			{
+				size_t last = std::min(count, first + this->maxQuads);
+				size_t size = last - first;
+				if (this->cursor + size > this->maxQuads * AGE_SPRITE_BUFFER_FRAMES) this->cursor = 0;
+				this->staging.clear();
+				for (size_t i = first; i < last; i++) this->staging.insert(this->staging.end(), this->quads[i].vertices, this->quads[i].vertices + 4);
+				this->vertices->SetData(this->cursor * 4 * sizeof(SpriteVertex), size * 4 * sizeof(SpriteVertex), this->staging.data());
+
+				for (size_t start = first, end = first; start < last; start = end)
+				{
+					const Quad& quad = this->quads[start];
+					for (end = start + 1; end < last && this->quads[end].shader == quad.shader && this->quads[end].texture == quad.texture; end++);
+					if (quad.shader != bound)
+					{
+						bound = quad.shader;
+						bound->Bind();
+						glProgramUniformMatrix4fv(bound->GetId(), 0, 1, GL_FALSE, this->projection);
+					}
+					quad.texture->Bind(0);
+					glDrawElementsBaseVertex(GL_TRIANGLES, (end - start) * 6, GL_UNSIGNED_INT, (void*)((start - first) * 6 * sizeof(uint)), this->cursor * 4);
+					this->drawCalls++;
+				}
+				this->cursor += size;
+			}
+			glBindVertexArray(0);
+
+			this->quads.clear();
+		}
+		void SpriteBatch::SetShader(Shader* shader)
+		{
+			if (shader == NULL) shader = this->defaultShader;
+			if (shader == this->shader) return;
+			if (this->order == PAINTER_ORDER) this->Flush();
+			this->shader = shader;
+		}
+		void SpriteBatch::Push(Texture* texture, float x, float y, float width, float height, float u0, float v0, float u1, float v1, uint32_t color, float depth)
+		{
+			if (texture == NULL) texture = this->white;
+			// DEPTH_ORDER keeps every quad until End so the whole frame is sorted together
+			if (this->order == PAINTER_ORDER && !(this->quads.empty()) && (this->quads.size() >= this->maxQuads || this->quads.back().texture != texture)) this->Flush();
+			Quad quad;
+			quad.shader = this->shader;
+			quad.texture = texture;
+			// depth is only a sort key, vertices carry no z
+			quad.depth = depth;
+			quad.vertices[0] = { x, y, u0, v0, color };
+			quad.vertices[1] = { x, y + height, u0, v1, color };
+			quad.vertices[2] = { x + width, y + height, u1, v1, color };
+			quad.vertices[3] = { x + width, y, u1, v0, color };
+			this->quads.push_back(quad);
+		}
+		void SpriteBatch::Draw(Texture* texture, Region dst, Region src, uint32_t color, float depth)
+		{
+			if (texture == NULL || src.width == 0 || src.height == 0)
+			{
+				this->Push(texture, dst.x, dst.y, dst.width, dst.height, 0, 0, 1, 1, color, depth);
+				return;
+			}
+			float w = (float)(texture->GetWidth());
+			float h = (float)(texture->GetHeight());
+			this->Push(texture, dst.x, dst.y, dst.width, dst.height, src.x / w, src.y / h, (src.x + src.width) / w, (src.y + src.height) / h, color, depth);
+		}
+		void SpriteBatch::DrawNineSlice(Texture* texture, Region dst, Region src, float left, float top, float right, float bottom, uint32_t color, float depth)
+		{
+			float w = texture == NULL ? 1.0f : (float)(texture->GetWidth());
+			float h = texture == NULL ? 1.0f : (float)(texture->GetHeight());
+			if (src.width == 0 || src.height == 0) src = { 0, 0, w, h };
+			float xs[4] = { dst.x, dst.x + left, dst.x + dst.width - right, dst.x + dst.width };
+			float ys[4] = { dst.y, dst.y + top, dst.y + dst.height - bottom, dst.y + dst.height };
+			float us[4] = { src.x / w, (src.x + left) / w, (src.x + src.width - right) / w, (src.x + src.width) / w };
+			float vs[4] = { src.y / h, (src.y + top) / h, (src.y + src.height - bottom) / h, (src.y + src.height) / h };
+			for (int row = 0; row < 3; row++)
+			{
+				for (int col = 0; col < 3; col++)
+				{
+					float width = xs[col + 1] - xs[col];
+					float height = ys[row + 1] - ys[row];
+					if (width <= 0 || height <= 0) continue;
+					this->Push(texture, xs[col], ys[row], width, height, us[col], vs[row], us[col + 1], vs[row + 1], color, depth);
+				}
+			}
+		}
+		void SpriteBatch::DrawString(Font* font, std::string text, float x, float y, float scale, uint32_t color, float depth)
+		{
+			float penX = x;
+			float penY = y;
+			for (size_t i = 0; i < text.length();)
+			{
+				uint codepoint = DecodeUTF8(text, i);
+				if (codepoint == '\n')
+				{
+					penX = x;
+					penY += font->GetLineHeight() * scale;
+					continue;
+				}
+				const Glyph* glyph = font->GetGlyph(codepoint);
+				if (glyph == NULL) continue;
+				if (glyph->width > 0)
+				{
+					this->Push(font->GetAtlas(), penX + glyph->offsetX * scale, penY + glyph->offsetY * scale, glyph->width * scale, glyph->height * scale, glyph->u0, glyph->v0, glyph->u1, glyph->v1, color, depth);
+				}
+				penX += glyph->advance * scale;
+			}
+		}
+		size_t SpriteBatch::GetDrawCalls()
+		{
+			return this->drawCalls;
+		}
+		uint32_t SpriteBatch::PackColor(float r, float g, float b, float a)
+		{
+			return (uint32_t)(r * 255.0f + 0.5f) | ((uint32_t)(g * 255.0f + 0.5f) << 8) | ((uint32_t)(b * 255.0f + 0.5f) << 16) | ((uint32_t)(a * 255.0f + 0.5f) << 24);
+		}
+	}
+}
@@ -0,0 +1,279 @@
+#include "include/agecmd.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace age
+{
+	namespace rp
+	{
+		enum CommandType : uint16_t
+		{
+			CMD_BIND_SHADER,
+			CMD_BIND_TEXTURE,
+			CMD_SET_UNIFORM,
+			CMD_DRAW_MESH,
+			CMD_UPDATE_BUFFER
+		};
+
+		struct BindShaderCommand
+		{
+			GLuint program;
+		};
+
+		struct BindTextureCommand
+		{
+			GLuint unit, texture;
+		};
+
+		// followed by the uniform values
+		struct SetUniformCommand
+		{
+			GLuint program;
+			GLint location;
+			GLenum type;
+			GLsizei count;
+		};
+
+		struct DrawMeshCommand
+		{
+			GLuint vao;
+			GLsizei count;
+		};
+
+		// followed by the buffer data
+		struct UpdateBufferCommand
+		{
+			GLuint buffer;
+			GLintptr offset;
+			GLsizeiptr size;
+		};
+
+		CommandBuffer::CommandBuffer(uint32_t capacity, size_t arenaSize) : arena(arenaSize)
+		{
+			this->entries = new Entry[capacity];
+			this->capacity = capacity;
+			this->count = 0;
+			this->overflow = false;
+		}
+		CommandBuffer::~CommandBuffer()
+		{
+			delete[] this->entries;
+		}
+		void CommandBuffer::Reset()
+		{
+			this->arena.Reset();
+			this->count = 0;
+			this->overflow = false;
+		}
+		void CommandBuffer::Sort()
+		{
+			std::sort(this->entries, this->entries + this->count, [](const Entry& a, const Entry& b) {
+				return a.key != b.key ? a.key < b.key : a.sequence < b.sequence;
+			});
+		}
+		uint32_t CommandBuffer::GetCount()
+		{
+			return this->count;
+		}
+		bool CommandBuffer::HasOverflowed()
+		{
+			return this->overflow;
+		}
+		void* CommandBuffer::Push(uint64_t key, uint16_t type, size_t size)
+		{
+			void* data = this->count < this->capacity ? this->arena.Allocate(size, alignof(UpdateBufferCommand)) : NULL;
+			if (data == NULL)
+			{
+				this->overflow = true;
+				return NULL;
+			}
+			Entry& entry = this->entries[this->count];
+			entry.key = key;
+			entry.sequence = this->count++;
+			entry.type = type;
+			entry.data = data;
+			return data;
+		}
+		bool CommandBuffer::BindShader(uint64_t key, Shader* shader)
+		{
+			return this->BindShader(key, shader->GetId());
+		}
+		bool CommandBuffer::BindShader(uint64_t key, GLuint program)
+		{
+			BindShaderCommand* command = (BindShaderCommand*)this->Push(key, CMD_BIND_SHADER, sizeof(BindShaderCommand));
+			if (command == NULL) return false;
+			command->program = program;
+			return true;
+		}
+		bool CommandBuffer::BindTexture(uint64_t key, GLuint unit, Texture* texture)
+		{
+			return this->BindTexture(key, unit, texture == NULL ? 0 : texture->GetId());
+		}
+		bool CommandBuffer::BindTexture(uint64_t key, GLuint unit, GLuint texture)
+		{
+			BindTextureCommand* command = (BindTextureCommand*)this->Push(key, CMD_BIND_TEXTURE, sizeof(BindTextureCommand));
+			if (command == NULL) return false;
+			command->unit = unit;
+			command->texture = texture;
+			return true;
+		}
+		bool CommandBuffer::SetUniform(uint64_t key, Shader* shader, GLint location, GLenum type, GLsizei count, const void* data)
+		{
+			return this->SetUniform(key, shader->GetId(), location, type, count, data);
+		}
+		bool CommandBuffer::SetUniform(uint64_t key, GLuint program, GLint location, GLenum type, GLsizei count, const void* data)
+		{
+			size_t size = CommandBuffer::GetUniformSize(type) * count;
+			if (size == 0) return false;
+			SetUniformCommand* command = (SetUniformCommand*)this->Push(key, CMD_SET_UNIFORM, sizeof(SetUniformCommand) + size);
+			if (command == NULL) return false;
+			command->program = program;
+			command->location = location;
+			command->type = type;
+			command->count = count;
+			memcpy(command + 1, data, size);
+			return true;
+		}
+		bool CommandBuffer::DrawMesh(uint64_t key, Mesh* mesh)
+		{
+			return this->DrawMesh(key, mesh->GetId(), mesh->GetCount());
+		}
+		bool CommandBuffer::DrawMesh(uint64_t key, GLuint vao, GLsizei count)
+		{
+			DrawMeshCommand* command = (DrawMeshCommand*)this->Push(key, CMD_DRAW_MESH, sizeof(DrawMeshCommand));
+			if (command == NULL) return false;
+			command->vao = vao;
+			command->count = count;
+			return true;
+		}
+		bool CommandBuffer::UpdateBuffer(uint64_t key, GLBuffer* buffer, GLintptr offset, GLsizeiptr size, const void* data)
+		{
+			return this->UpdateBuffer(key, buffer->GetId(), offset, size, data);
+		}
+		bool CommandBuffer::UpdateBuffer(uint64_t key, GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data)
+		{
+			UpdateBufferCommand* command = (UpdateBufferCommand*)this->Push(key, CMD_UPDATE_BUFFER, sizeof(UpdateBufferCommand) + size);
+			if (command == NULL) return false;
+			command->buffer = buffer;
+			command->offset = offset;
+			command->size = size;
+			memcpy(command + 1, data, size);
+			return true;
+		}
+		void CommandBuffer::Execute(const Entry& entry)
+		{
+			switch (entry.type)
+			{
+			case CMD_BIND_SHADER:
+			{
+				const BindShaderCommand* command = (const BindShaderCommand*)entry.data;
+				Shader::BindProgram(command->program);
+				break;
+			}
+			case CMD_BIND_TEXTURE:
+			{
+				const BindTextureCommand* command = (const BindTextureCommand*)entry.data;
+				glBindTextureUnit(command->unit, command->texture);
+				break;
+			}
+			case CMD_SET_UNIFORM:
+			{
+				const SetUniformCommand* command = (const SetUniformCommand*)entry.data;
+				const void* values = command + 1;
+				switch (command->type)
+				{
+				case GL_FLOAT: glProgramUniform1fv(command->program, command->location, command->count, (const GLfloat*)values); break;
+				case GL_FLOAT_VEC2: glProgramUniform2fv(command->program, command->location, command->count, (const GLfloat*)values); break;
+				case GL_FLOAT_VEC3: glProgramUniform3fv(command->program, command->location, command->count, (const GLfloat*)values); break;
+				case GL_FLOAT_VEC4: glProgramUniform4fv(command->program, command->location, command->count, (const GLfloat*)values); break;
+				case GL_INT: glProgramUniform1iv(command->program, command->location, command->count, (const GLint*)values); break;
+				case GL_INT_VEC2: glProgramUniform2iv(command->program, command->location, command->count, (const GLint*)values); break;
+				case GL_INT_VEC3: glProgramUniform3iv(command->program, command->location, command->count, (const GLint*)values); break;
+				case GL_INT_VEC4: glProgramUniform4iv(command->program, command->location, command->count, (const GLint*)values); break;
+				case GL_UNSIGNED_INT: glProgramUniform1uiv(command->program, command->location, command->count, (const GLuint*)values); break;
+				case GL_FLOAT_MAT3: glProgramUniformMatrix3fv(command->program, command->location, command->count, GL_FALSE, (const GLfloat*)values); break;
+				case GL_FLOAT_MAT4: glProgramUniformMatrix4fv(command->program, command->location, command->count, GL_FALSE, (const GLfloat*)values); break;
+				default: break;
+				}
+				break;
+			}
+			case CMD_DRAW_MESH:
+			{
+				const DrawMeshCommand* command = (const DrawMeshCommand*)entry.data;
+				glBindVertexArray(command->vao);
+				glDrawElements(GL_TRIANGLES, command->count, GL_UNSIGNED_INT, 0);
+				break;
+			}
+			case CMD_UPDATE_BUFFER:
+			{
+				const UpdateBufferCommand* command = (const UpdateBufferCommand*)entry.data;
+				glNamedBufferSubData(command->buffer, command->offset, command->size, command + 1);
+				break;
+			}
+			default:
+				break;
+			}
+		}
+		void CommandBuffer::Replay()
+		{
+			CommandBuffer* self = this;
+			CommandBuffer::Submit(1, &self);
+		}
+		void CommandBuffer::Submit(size_t count, CommandBuffer* const* buffers)
+		{
+			// k-way merge of the sorted buffers through a min-heap of buffer heads, ties go to the buffer submitted first
+			std::vector<uint32_t> heads(count, 0);
+			std::vector<size_t> heap;
+			heap.reserve(count);
+			auto later = [&](size_t a, size_t b) {
+				uint64_t keyA = buffers[a]->entries[heads[a]].key;
+				uint64_t keyB = buffers[b]->entries[heads[b]].key;
+				return keyA != keyB ? keyA > keyB : a > b;
+			};
+			for (size_t i = 0; i < count; i++)
+			{
+				if (buffers[i]->count > 0) heap.push_back(i);
+			}
+			std::make_heap(heap.begin(), heap.end(), later);
+			while (!(heap.empty()))
+			{
+				std::pop_heap(heap.begin(), heap.end(), later);
+				size_t next = heap.back();
+				heap.pop_back();
+				// drain the run that stays ahead of every other buffer without touching the heap
+				const Entry* entries = buffers[next]->entries;
+				uint32_t end = buffers[next]->count;
+				do
+				{
+					CommandBuffer::Execute(entries[heads[next]++]);
+				} while (heads[next] < end && (heap.empty() || !later(next, heap.front())));
+				if (heads[next] < end)
+				{
+					heap.push_back(next);
+					std::push_heap(heap.begin(), heap.end(), later);
+				}
+			}
+			glBindVertexArray(0);
+		}
+		size_t CommandBuffer::GetUniformSize(GLenum type)
+		{
+			switch (type)
+			{
+			case GL_FLOAT: return sizeof(GLfloat);
+			case GL_FLOAT_VEC2: return 2 * sizeof(GLfloat);
+			case GL_FLOAT_VEC3: return 3 * sizeof(GLfloat);
+			case GL_FLOAT_VEC4: return 4 * sizeof(GLfloat);
+			case GL_INT: return sizeof(GLint);
+			case GL_INT_VEC2: return 2 * sizeof(GLint);
+			case GL_INT_VEC3: return 3 * sizeof(GLint);
+			case GL_INT_VEC4: return 4 * sizeof(GLint);
+			case GL_UNSIGNED_INT: return sizeof(GLuint);
+			case GL_FLOAT_MAT3: return 9 * sizeof(GLfloat);
+			case GL_FLOAT_MAT4: return 16 * sizeof(GLfloat);
+			default: return 0;
+			}
+		}
+	}
+}
@@ -0,0 +1,115 @@
+#include "include/ageloop.hpp"
+
+#include <windows.h>
+
+#define AGE_SPIN_MARGIN 0.002
+
+namespace age
+{
+	namespace rl
+	{
+		RunLoop::RunLoop(double step, size_t latency) : maxSteps(8), running(false), tick(0), fence(AGE_MAX_FRAME_LATENCY + 1)
+		{
+			this->step = step;
+			this->SetLatency(latency);
+			this->start = std::chrono::steady_clock::now();
+			this->OnSimulate = NULL;
+			this->OnRender = NULL;
+		}
+		RunLoop::~RunLoop()
+		{
+			this->Stop();
+		}
+		double RunLoop::GetStep()
+		{
+			return this->step;
+		}
+		int RunLoop::GetMaxSteps()
+		{
+			return this->maxSteps.load(std::memory_order_relaxed);
+		}
+		void RunLoop::SetMaxSteps(int maxSteps)
+		{
+			this->maxSteps.store(maxSteps > 0 ? maxSteps : 1, std::memory_order_relaxed);
+		}
+		size_t RunLoop::GetLatency()
+		{
+			return this->latency;
+		}
+		void RunLoop::SetLatency(size_t latency)
+		{
+			this->latency = latency < AGE_MAX_FRAME_LATENCY ? latency : AGE_MAX_FRAME_LATENCY;
+		}
+		uint64_t RunLoop::GetTick()
+		{
+			return this->tick.load(std::memory_order_acquire);
+		}
+		double RunLoop::GetTime()
+		{
+			return std::chrono::duration<double>(std::chrono::steady_clock::now() - this->start).count();
+		}
+		float RunLoop::GetAlpha(double stateTime)
+		{
+			double alpha = (this->GetTime() - stateTime) / this->step;
+			if (alpha < 0) return 0;
+			if (alpha > 1) return 1;
+			return (float)alpha;
+		}
+		void RunLoop::Simulate()
+		{
+			// the default 15.6 ms timer resolution would make a 60 Hz step oversleep into bursts of two ticks
+			timeBeginPeriod(1);
+			double next = this->GetTime() + this->step;
+			while (this->running.load(std::memory_order_acquire))
+			{
+				double now = this->GetTime();
+				if (now < next)
+				{
+					// sleep most of the wait, then yield through the last moments to hit the tick on time
+					if (next - now > AGE_SPIN_MARGIN) std::this_thread::sleep_for(std::chrono::duration<double>(next - now - AGE_SPIN_MARGIN));
+					else std::this_thread::yield();
+					continue;
+				}
+				// drop the backlog instead of spiralling when a tick takes longer than the step
+				int maxSteps = this->maxSteps.load(std::memory_order_relaxed);
+				if (now - next > maxSteps * this->step) next = now;
+				for (int i = 0; i < maxSteps && next <= now; i++)
+				{
+					if (this->OnSimulate != NULL) this->OnSimulate(this, this->step);
+					this->tick.fetch_add(1, std::memory_order_release);
+					next += this->step;
+				}
+			}
+			timeEndPeriod(1);
+		}
+		void RunLoop::Start()
+		{
+			if (this->running.exchange(true)) return;
+			this->start = std::chrono::steady_clock::now();
+			this->simulation = std::thread(&RunLoop::Simulate, this);
+		}
+		void RunLoop::Stop()
+		{
+			if (!(this->running.exchange(false))) return;
+			this->simulation.join();
+		}
+		bool RunLoop::IsRunning()
+		{
+			return this->running.load(std::memory_order_acquire);
+		}
+		void RunLoop::Run(wnd::Window* window)
+		{
+			this->Start();
+			while (!(window->ShouldClose()))
+			{
+				window->HandleEvents();
+				this->fence.Wait(this->latency, GL_TIMEOUT_IGNORED);
+				if (this->OnRender != NULL) this->OnRender(this, window);
+				window->SwapBuffers();
+				this->fence.Signal();
+			}
+			this->fence.Wait(0, GL_TIMEOUT_IGNORED);
+			this->Stop();
+		}
+	}
+}
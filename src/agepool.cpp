@@ -0,0 +1,146 @@
+#include "include/agepool.hpp"
+
+#include <vector>
+
+namespace age
+{
+	namespace rp
+	{
+		LinearArena::LinearArena(size_t capacity)
+		{
+			this->memory = new unsigned char[capacity];
+			this->capacity = capacity;
+			this->offset = 0;
+		}
+		LinearArena::~LinearArena()
+		{
+			delete[] this->memory;
+		}
+		void* LinearArena::Allocate(size_t size, size_t alignment)
+		{
+			size_t address = (size_t)(this->memory) + this->offset;
+			size_t padding = (alignment - address % alignment) % alignment;
+			if (this->offset + padding + size > this->capacity) return NULL;
+			this->offset += padding + size;
+			return this->memory + this->offset - size;
+		}
+		void LinearArena::Reset()
+		{
+			this->offset = 0;
+		}
+		size_t LinearArena::GetCapacity()
+		{
+			return this->capacity;
+		}
+		size_t LinearArena::GetUsed()
+		{
+			return this->offset;
+		}
+
+		ResourcePools::ResourcePools(uint32_t capacity, size_t arenaSize, size_t framesInFlight) : fence(framesInFlight + 1), arena(arenaSize), buffers(capacity), textures(capacity), meshes(capacity), shaders(capacity) {}
+		ResourcePools::~ResourcePools()
+		{
+			this->fence.Wait(0, GL_TIMEOUT_IGNORED);
+		}
+		void ResourcePools::BeginFrame()
+		{
+			uint64_t completed = this->fence.GetCompletedFrame();
+			this->buffers.Collect(completed);
+			this->textures.Collect(completed);
+			this->meshes.Collect(completed);
+			this->shaders.Collect(completed);
+			this->arena.Reset();
+		}
+		void ResourcePools::EndFrame()
+		{
+			this->fence.Signal();
+		}
+		uint64_t ResourcePools::GetFrame()
+		{
+			return this->fence.GetFrame();
+		}
+		LinearArena* ResourcePools::GetArena()
+		{
+			return &this->arena;
+		}
+		BufferHandle ResourcePools::CreateBuffer(BufSize size, GLenum type, const void* data, GLbitfield flags)
+		{
+			return this->buffers.Create(size, type, data, flags);
+		}
+		TextureHandle ResourcePools::CreateTexture(GLenum type, int width, int height, int depth, int levels, GLenum format, GLenum filter, GLenum wrapMode)
+		{
+			return this->textures.Create(type, width, height, depth, levels, format, filter, wrapMode);
+		}
+		TextureHandle ResourcePools::CreateCubeMap(int width, int height, GLenum format, GLenum filter, GLenum wrapMode)
+		{
+			return this->textures.Create(GL_TEXTURE_CUBE_MAP, width, height, 1, 1, format, filter, wrapMode);
+		}
+		MeshHandle ResourcePools::CreateMesh(size_t vboCount, const BufferHandle* vbos, size_t indexCount, const uint* indices)
+		{
+			// resolved on the stack so persistent meshes do not depend on the transient frame arena
+			MeshHandle handle = { 0 };
+			GLBuffer* local[AGE_MAX_MESH_VBOS];
+			std::vector<GLBuffer*> overflow;
+			if (vboCount > AGE_MAX_MESH_VBOS) overflow.resize(vboCount);
+			GLBuffer** resolved = vboCount > AGE_MAX_MESH_VBOS ? overflow.data() : local;
+			for (size_t i = 0; i < vboCount; i++)
+			{
+				resolved[i] = this->buffers.Get(vbos[i]);
+				if (resolved[i] == NULL) return handle;
+			}
+			return this->meshes.Create(vboCount, resolved, indexCount, indices);
+		}
+		ShaderHandle ResourcePools::CreateShader(size_t count, const GLuint* shaders)
+		{
+			return this->shaders.Create(count, shaders);
+		}
+		GLBuffer* ResourcePools::Get(BufferHandle handle)
+		{
+			return this->buffers.Get(handle);
+		}
+		Texture* ResourcePools::Get(TextureHandle handle)
+		{
+			return this->textures.Get(handle);
+		}
+		Mesh* ResourcePools::Get(MeshHandle handle)
+		{
+			return this->meshes.Get(handle);
+		}
+		Shader* ResourcePools::Get(ShaderHandle handle)
+		{
+			return this->shaders.Get(handle);
+		}
+		void ResourcePools::Destroy(BufferHandle handle)
+		{
+			this->buffers.Destroy(handle, this->fence.GetFrame());
+		}
+		void ResourcePools::Destroy(TextureHandle handle)
+		{
+			this->textures.Destroy(handle, this->fence.GetFrame());
+		}
+		void ResourcePools::Destroy(MeshHandle handle)
+		{
+			this->meshes.Destroy(handle, this->fence.GetFrame());
+		}
+		void ResourcePools::Destroy(ShaderHandle handle)
+		{
+			this->shaders.Destroy(handle, this->fence.GetFrame());
+		}
+		Pool<GLBuffer>* ResourcePools::GetBuffers()
+		{
+			return &this->buffers;
+		}
+		Pool<Texture>* ResourcePools::GetTextures()
+		{
+			return &this->textures;
+		}
+		Pool<Mesh>* ResourcePools::GetMeshes()
+		{
+			return &this->meshes;
+		}
+		Pool<Shader>* ResourcePools::GetShaders()
+		{
+			return &this->shaders;
+		}
+	}
+}
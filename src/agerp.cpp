@@ -1,5 +1,8 @@
 #include "include/agerp.hpp"
 
+#include <algorithm>
+#include <sstream>
+
 namespace age
 {
 	namespace rp
@@ -51,6 +54,14 @@ namespace age
 			glDeleteVertexArrays(1, &this->id);
 			glDeleteBuffers(1, &this->ebo);
 		}
+		GLuint Mesh::GetId()
+		{
+			return this->id;
+		}
+		size_t Mesh::GetCount()
+		{
+			return this->count;
+		}
 		void Mesh::SetVBO(GLuint binding, GLBuffer* vbo)
 		{
 			glEnableVertexArrayAttrib(this->id, binding);
@@ -70,8 +81,9 @@ namespace age
 		{
 			this->count = count;
 			this->program = glCreateProgram();
-			this->shaders = new GLuint[count];
-			for (size_t i = 0; i < count; i++)
+			// the usual stage count fits inline, larger programs still get every attachment
+			this->shaders = count <= AGE_MAX_SHADER_STAGES ? this->inlineShaders : new GLuint[count];
+			for (size_t i = 0; i < this->count; i++)
 			{
 				this->shaders[i] = shaders[i];
 				glAttachShader(this->program, shaders[i]);
@@ -86,15 +98,21 @@ namespace age
 				glDetachShader(this->program, this->shaders[i]);
 			}
 			glDeleteProgram(this->program);
-			delete[] this->shaders;
+			if (this->shaders != this->inlineShaders) delete[] this->shaders;
+		}
+		GLuint Shader::GetId()
+		{
+			return this->program;
+		}
+		bool Shader::IsLinked()
+		{
+			GLint status = GL_FALSE;
+			glGetProgramiv(this->program, GL_LINK_STATUS, &status);
+			return status == GL_TRUE;
 		}
 		void Shader::Bind()
 		{
-			if (boundShaderProgram != this->program)
-			{
-				boundShaderProgram = this->program;
-				glUseProgram(boundShaderProgram);
-			}
+			Shader::BindProgram(this->program);
 		}
 		void Shader::Unbind()
 		{
@@ -126,6 +144,276 @@ namespace age
 		{
 			glDeleteShader(detachedShader);
 		}
+		void Shader::BindProgram(GLuint program)
+		{
+			if (boundShaderProgram != program)
+			{
+				boundShaderProgram = program;
+				glUseProgram(boundShaderProgram);
+			}
+		}
+
+		static bool ParseInclude(const std::string& line, std::string& name)
+		{
+			size_t i = line.find_first_not_of(" \t");
+			if (i == std::string::npos || line[i] != '#') return false;
+			i = line.find_first_not_of(" \t", i + 1);
+			if (i == std::string::npos || line.compare(i, 7, "include") != 0) return false;
+			i = line.find_first_not_of(" \t", i + 7);
+			if (i == std::string::npos || (line[i] != '"' && line[i] != '<')) return false;
+			size_t end = line.find(line[i] == '"' ? '"' : '>', i + 1);
+			if (end == std::string::npos) return false;
+			name = line.substr(i + 1, end - i - 1);
+			return true;
+		}
+		void ShaderPreprocessor::AddDirectory(std::string path)
+		{
+			if (!path.empty() && path.back() != '/' && path.back() != '\\') path += '/';
+			this->directories.push_back(path);
+		}
+		void ShaderPreprocessor::AddSource(std::string name, std::string src)
+		{
+			this->sources[name] = src;
+		}
+		bool ShaderPreprocessor::Resolve(std::string name, std::string& src)
+		{
+			std::map<std::string, std::string>::iterator it = this->sources.find(name);
+			if (it != this->sources.end())
+			{
+				src = it->second;
+				return true;
+			}
+			for (size_t i = 0; i < this->directories.size(); i++)
+			{
+				std::ifstream input(this->directories[i] + name);
+				if (!input) continue;
+				src.assign(std::istreambuf_iterator<char>(input), {});
+				this->sources[name] = src;
+				return true;
+			}
+			return false;
+		}
+		bool ShaderPreprocessor::Expand(std::string src, int file, std::vector<std::string>& files, std::string& out)
+		{
+			std::istringstream input(src);
+			std::string line, name;
+			int number = 0;
+			while (std::getline(input, line))
+			{
+				number++;
+				if (!ParseInclude(line, name))
+				{
+					out += line;
+					out += '\n';
+					continue;
+				}
+				if (std::find(files.begin(), files.end(), name) == files.end())
+				{
+					// a failed include stays last in files so the caller can report it
+					int index = files.size();
+					files.push_back(name);
+					std::string content;
+					if (!this->Resolve(name, content)) return false;
+					out += "#line 1 " + std::to_string(index) + "\n";
+					if (!this->Expand(content, index, files, out)) return false;
+				}
+				out += "#line " + std::to_string(number + 1) + " " + std::to_string(file) + "\n";
+			}
+			return true;
+		}
+		bool ShaderPreprocessor::Process(std::string src, const ShaderDefines& defines, std::string& out)
+		{
+			std::vector<std::string> files;
+			return this->Process(src, defines, out, files);
+		}
+		bool ShaderPreprocessor::Process(std::string src, const ShaderDefines& defines, std::string& out, std::vector<std::string>& files)
+		{
+			// source string 0 is the stage source itself, includes follow in the order they were first seen
+			files.assign(1, std::string());
+			std::string expanded;
+			if (!this->Expand(src, 0, files, expanded)) return false;
+
+			// defines must follow #version, which has to stay the first directive
+			size_t insert = 0;
+			int line = 1;
+			size_t version = expanded.find("#version");
+			if (version != std::string::npos)
+			{
+				insert = expanded.find('\n', version);
+				insert = insert == std::string::npos ? expanded.size() : insert + 1;
+				for (size_t i = 0; i < version; i++) if (expanded[i] == '\n') line++;
+				line++;
+			}
+			std::string header;
+			for (ShaderDefines::const_iterator it = defines.begin(); it != defines.end(); it++)
+			{
+				header += "#define " + it->first + " " + it->second + "\n";
+			}
+			header += "#line " + std::to_string(line) + " 0\n";
+			out = expanded.substr(0, insert) + header + expanded.substr(insert);
+			return true;
+		}
+
+		ShaderCache::ShaderCache(ShaderPreprocessor* preprocessor)
+		{
+			this->preprocessor = preprocessor;
+			this->failures = 0;
+			this->hits = 0;
+			this->misses = 0;
+		}
+		ShaderCache::~ShaderCache()
+		{
+			this->Clear();
+		}
+		void ShaderCache::AddProgram(std::string name, size_t count, const GLenum* types, const std::string* sources)
+		{
+			Program& program = this->programs[name];
+			// variants built from the previous sources must not outlive them
+			this->Evict(program);
+			program.types.assign(types, types + count);
+			program.sources.assign(sources, sources + count);
+		}
+		void ShaderCache::Evict(Program& program)
+		{
+			for (size_t i = 0; i < program.keys.size(); i++)
+			{
+				std::unordered_map<std::string, Shader*>::iterator it = this->variants.find(program.keys[i]);
+				if (it == this->variants.end()) continue;
+				if (it->second == NULL) this->failures--;
+				delete it->second;
+				this->variants.erase(it);
+				this->logs.erase(program.keys[i]);
+			}
+			program.keys.clear();
+		}
+		static std::string GetShaderLog(GLuint shader)
+		{
+			GLint length = 0;
+			glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+			// the reported length counts the terminator, keep only what was written
+			GLsizei written = 0;
+			std::string log(length > 0 ? length : 0, '\0');
+			if (length > 0) glGetShaderInfoLog(shader, length, &written, &log[0]);
+			log.resize(written);
+			return log;
+		}
+		static std::string GetProgramLog(GLuint program)
+		{
+			GLint length = 0;
+			glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+			GLsizei written = 0;
+			std::string log(length > 0 ? length : 0, '\0');
+			if (length > 0) glGetProgramInfoLog(program, length, &written, &log[0]);
+			log.resize(written);
+			return log;
+		}
+		Shader* ShaderCache::Compile(Program& program, const ShaderDefines& defines, std::string& log)
+		{
+			std::vector<GLuint> shaders;
+			bool compiled = true;
+			for (size_t i = 0; i < program.types.size() && compiled; i++)
+			{
+				std::string src;
+				std::vector<std::string> files;
+				if (!(this->preprocessor->Process(program.sources[i], defines, src, files)))
+				{
+					log = "stage " + std::to_string(i) + ": cannot resolve include \"" + files.back() + "\"\n";
+					compiled = false;
+					break;
+				}
+				GLuint shader = Shader::CreateShader(program.types[i], src);
+				GLint status = GL_FALSE;
+				glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+				compiled = status == GL_TRUE;
+				shaders.push_back(shader);
+				if (!compiled)
+				{
+					// map the #line source string numbers back to file names
+					log = "stage " + std::to_string(i) + ":\n" + GetShaderLog(shader);
+					for (size_t j = 1; j < files.size(); j++) log += "source " + std::to_string(j) + ": " + files[j] + "\n";
+				}
+			}
+			Shader* result = NULL;
+			if (compiled)
+			{
+				result = new Shader(shaders.size(), shaders.data());
+				if (!(result->IsLinked()))
+				{
+					log = "link:\n" + GetProgramLog(result->GetId());
+					delete result;
+					result = NULL;
+				}
+			}
+			// attached shaders are only flagged for deletion and released when the program detaches them
+			for (size_t i = 0; i < shaders.size(); i++) Shader::DeleteShader(shaders[i]);
+			return result;
+		}
+		Shader* ShaderCache::GetVariant(std::string name, const ShaderDefines& defines)
+		{
+			std::string key = ShaderCache::GetKey(name, defines);
+			std::unordered_map<std::string, Shader*>::iterator it = this->variants.find(key);
+			if (it != this->variants.end())
+			{
+				// cached failures are not hits, their log is kept for GetLog
+				if (it->second != NULL) this->hits++;
+				return it->second;
+			}
+			std::map<std::string, Program>::iterator program = this->programs.find(name);
+			if (program == this->programs.end()) return NULL;
+			this->misses++;
+			std::string log;
+			Shader* shader = this->Compile(program->second, defines, log);
+			if (shader == NULL)
+			{
+				this->failures++;
+				this->logs[key] = log;
+			}
+			program->second.keys.push_back(key);
+			this->variants[key] = shader;
+			return shader;
+		}
+		size_t ShaderCache::GetVariantCount(std::string name)
+		{
+			std::map<std::string, Program>::iterator program = this->programs.find(name);
+			return program == this->programs.end() ? 0 : program->second.keys.size();
+		}
+		std::string ShaderCache::GetLog(std::string name, const ShaderDefines& defines)
+		{
+			std::unordered_map<std::string, std::string>::iterator it = this->logs.find(ShaderCache::GetKey(name, defines));
+			return it == this->logs.end() ? std::string() : it->second;
+		}
+		ShaderStats ShaderCache::GetStats()
+		{
+			ShaderStats stats = { this->programs.size(), this->variants.size(), this->failures, this->hits, this->misses, 0 };
+			for (std::map<std::string, Program>::iterator it = this->programs.begin(); it != this->programs.end(); it++)
+			{
+				if (it->second.keys.size() > stats.maxVariants) stats.maxVariants = it->second.keys.size();
+			}
+			return stats;
+		}
+		void ShaderCache::Clear()
+		{
+			for (std::unordered_map<std::string, Shader*>::iterator it = this->variants.begin(); it != this->variants.end(); it++)
+			{
+				delete it->second;
+			}
+			this->variants.clear();
+			this->logs.clear();
+			this->failures = 0;
+			for (std::map<std::string, Program>::iterator it = this->programs.begin(); it != this->programs.end(); it++)
+			{
+				it->second.keys.clear();
+			}
+		}
+		std::string ShaderCache::GetKey(std::string name, const ShaderDefines& defines)
+		{
+			std::string key = name;
+			for (ShaderDefines::const_iterator it = defines.begin(); it != defines.end(); it++)
+			{
+				key += '|' + it->first + '=' + it->second;
+			}
+			return key;
+		}
 
 		Texture::Texture(GLenum type, int width, int height, int depth, int levels, GLenum format, GLenum filter, GLenum wrapMode)
 		{
@@ -271,5 +559,57 @@ namespace age
 		{
 			glBindImageTexture(index, 0, level, layered, layer, access, this->format);
 		}
+
+		FrameFence::FrameFence(size_t count)
+		{
+			this->count = count > 0 ? count : 1;
+			this->fences = new GLsync[this->count];
+			this->frame = 0;
+			this->completed = 0;
+		}
+		FrameFence::~FrameFence()
+		{
+			while (this->completed < this->frame) this->Release();
+			delete[] this->fences;
+		}
+		void FrameFence::Release()
+		{
+			glDeleteSync(this->fences[this->completed % this->count]);
+			this->completed++;
+		}
+		size_t FrameFence::GetCount()
+		{
+			return this->count;
+		}
+		uint64_t FrameFence::GetFrame()
+		{
+			return this->frame;
+		}
+		uint64_t FrameFence::GetCompletedFrame()
+		{
+			while (this->completed < this->frame)
+			{
+				GLenum status = glClientWaitSync(this->fences[this->completed % this->count], 0, 0);
+				if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+				this->Release();
+			}
+			return this->completed;
+		}
+		void FrameFence::Signal()
+		{
+			if (this->frame - this->completed >= this->count) this->Wait(this->count - 1, GL_TIMEOUT_IGNORED);
+			this->fences[this->frame % this->count] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			this->frame++;
+		}
+		bool FrameFence::Wait(size_t framesInFlight, GLuint64 timeout)
+		{
+			while (this->frame - this->completed > framesInFlight)
+			{
+				GLenum status = glClientWaitSync(this->fences[this->completed % this->count], GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+				if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return false;
+				this->Release();
+			}
+			return true;
+		}
 	}
 }
@@ -4,5 +4,9 @@
 #include "agedef.hpp"
 #include "window.hpp"
 #include "agerp.hpp"
+#include "agepool.hpp"
+#include "agecmd.hpp"
+#include "age2d.hpp"
+#include "ageloop.hpp"
 
 #endif
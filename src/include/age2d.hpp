@@ -0,0 +1,107 @@
+#ifndef AGE_2D_HPP
+#define AGE_2D_HPP
+
+#include "agedef.hpp"
+#include "agerp.hpp"
+
+#define AGE_SPRITE_BUFFER_FRAMES 3
+
+namespace age
+{
+	namespace rp
+	{
+		struct Region
+		{
+			float x, y, width, height;
+		};
+
+		struct SpriteVertex
+		{
+			float x, y;
+			float u, v;
+			uint32_t color;
+		};
+
+		struct Glyph
+		{
+			float u0, v0, u1, v1;
+			int width, height, offsetX, offsetY, advance;
+		};
+
+		enum SpriteOrder
+		{
+			PAINTER_ORDER,
+			DEPTH_ORDER
+		};
+
+		// Rasterizes glyphs of a font file on first use into a single channel atlas texture.
+		// Glyphs that do not fit are drawn blank until ClearAtlas, which must not be called between SpriteBatch Begin and End.
+		class AGE_API Font
+		{
+		private:
+			void *dc, *font;
+			std::string file;
+			Texture* atlas;
+			int atlasSize, penX, penY, rowHeight;
+			int ascent, lineHeight;
+			bool full;
+			std::unordered_map<uint, Glyph> glyphs;
+			std::vector<unsigned char> raster, pixels;
+			bool Rasterize(uint codepoint, Glyph& glyph);
+		public:
+			Font(std::string file, std::string face, int size, int atlasSize);
+			~Font();
+			const Glyph* GetGlyph(uint codepoint);
+			bool IsAtlasFull();
+			void ClearAtlas();
+			Texture* GetAtlas();
+			int GetAscent();
+			int GetLineHeight();
+		};
+
+		// Accumulates textured quads into a streaming vertex buffer and draws each run sharing a shader and texture at once.
+		// Depth only orders quads in DEPTH_ORDER (larger is drawn first), it is not written to the depth buffer.
+		// PAINTER_ORDER flushes every maxQuads, DEPTH_ORDER keeps the whole frame until End and sorts it at once.
+		// Begin disables depth test and culling and sets alpha blending, End restores the previous state.
+		// Custom shaders take the projection matrix at uniform location 0 and the texture at binding 0.
+		class AGE_API SpriteBatch
+		{
+		private:
+			struct Quad
+			{
+				Shader* shader;
+				Texture* texture;
+				float depth;
+				SpriteVertex vertices[4];
+			};
+			GLBuffer* vertices;
+			GLBuffer* indices;
+			GLuint vao;
+			Shader* defaultShader;
+			Shader* shader;
+			Texture* white;
+			std::vector<Quad> quads;
+			std::vector<SpriteVertex> staging;
+			size_t maxQuads, cursor, drawCalls;
+			SpriteOrder order;
+			float projection[16];
+			GLboolean depthTest, cullFace, blend;
+			GLint blendFunc[4];
+			void Push(Texture* texture, float x, float y, float width, float height, float u0, float v0, float u1, float v1, uint32_t color, float depth);
+		public:
+			SpriteBatch(size_t maxQuads);
+			~SpriteBatch();
+			void Begin(int width, int height, SpriteOrder order);
+			void End();
+			void Flush();
+			void SetShader(Shader* shader);
+			void Draw(Texture* texture, Region dst, Region src, uint32_t color, float depth);
+			void DrawNineSlice(Texture* texture, Region dst, Region src, float left, float top, float right, float bottom, uint32_t color, float depth);
+			void DrawString(Font* font, std::string text, float x, float y, float scale, uint32_t color, float depth);
+			size_t GetDrawCalls();
+			static uint32_t PackColor(float r, float g, float b, float a);
+		};
+	}
+}
+
+#endif
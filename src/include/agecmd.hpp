@@ -0,0 +1,56 @@
+#ifndef AGE_COMMAND_HPP
+#define AGE_COMMAND_HPP
+
+#include "agedef.hpp"
+#include "agerp.hpp"
+#include "agepool.hpp"
+
+namespace age
+{
+	namespace rp
+	{
+		// Records GL work without touching the context, so any thread can fill its own buffer.
+		// Buffers are sorted by key and replayed on the thread holding the context with CommandBuffer::Submit.
+		class AGE_API CommandBuffer
+		{
+		private:
+			struct Entry
+			{
+				uint64_t key;
+				uint32_t sequence;
+				uint16_t type;
+				const void* data;
+			};
+			LinearArena arena;
+			Entry* entries;
+			uint32_t capacity, count;
+			bool overflow;
+			void* Push(uint64_t key, uint16_t type, size_t size);
+			static void Execute(const Entry& entry);
+		public:
+			CommandBuffer(uint32_t capacity, size_t arenaSize);
+			~CommandBuffer();
+			CommandBuffer(const CommandBuffer&) = delete;
+			CommandBuffer& operator=(const CommandBuffer&) = delete;
+			void Reset();
+			void Sort();
+			uint32_t GetCount();
+			bool HasOverflowed();
+			bool BindShader(uint64_t key, Shader* shader);
+			bool BindShader(uint64_t key, GLuint program);
+			bool BindTexture(uint64_t key, GLuint unit, Texture* texture);
+			bool BindTexture(uint64_t key, GLuint unit, GLuint texture);
+			bool SetUniform(uint64_t key, Shader* shader, GLint location, GLenum type, GLsizei count, const void* data);
+			bool SetUniform(uint64_t key, GLuint program, GLint location, GLenum type, GLsizei count, const void* data);
+			bool DrawMesh(uint64_t key, Mesh* mesh);
+			bool DrawMesh(uint64_t key, GLuint vao, GLsizei count);
+			bool UpdateBuffer(uint64_t key, GLBuffer* buffer, GLintptr offset, GLsizeiptr size, const void* data);
+			bool UpdateBuffer(uint64_t key, GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data);
+			void Replay();
+			static void Submit(size_t count, CommandBuffer* const* buffers);
+			static size_t GetUniformSize(GLenum type);
+		};
+	}
+}
+
+#endif
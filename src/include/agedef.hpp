@@ -8,6 +8,7 @@
 #endif
 
 #include <GL/glew.h>
+#include <cstdint>
 #include <fstream>
 #include <string>
 
@@ -0,0 +1,85 @@
+#ifndef AGE_LOOP_HPP
+#define AGE_LOOP_HPP
+
+#include "agedef.hpp"
+#include "window.hpp"
+#include "agerp.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#define AGE_MAX_FRAME_LATENCY 4
+
+namespace age
+{
+	namespace rl
+	{
+		// Single producer (simulation) / single consumer (render) triple buffer.
+		// The writer fills GetBack() and calls Publish(), the reader calls Acquire() and reads GetFront().
+		template <typename T>
+		class TripleBuffer
+		{
+		private:
+			static const uint FRESH = 4;
+			T slots[3];
+			std::atomic<uint> middle;
+			uint back, front;
+		public:
+			TripleBuffer() : middle(1), back(0), front(2) {}
+			T* GetBack() { return &this->slots[this->back]; }
+			T* GetFront() { return &this->slots[this->front]; }
+			void Publish()
+			{
+				this->back = this->middle.exchange(this->back | FRESH, std::memory_order_acq_rel) & 3;
+			}
+			bool Acquire()
+			{
+				if (!(this->middle.load(std::memory_order_relaxed) & FRESH)) return false;
+				this->front = this->middle.exchange(this->front, std::memory_order_acq_rel) & 3;
+				return true;
+			}
+		};
+
+		// Render state handed over by the simulation: the last two ticks and the loop time the current one was published at.
+		template <typename T>
+		struct Snapshot
+		{
+			T previous, current;
+			double time;
+		};
+
+		class AGE_API RunLoop
+		{
+		private:
+			double step;
+			std::atomic<int> maxSteps;
+			size_t latency;
+			std::atomic<bool> running;
+			std::atomic<uint64_t> tick;
+			std::chrono::steady_clock::time_point start;
+			std::thread simulation;
+			rp::FrameFence fence;
+			void Simulate();
+		public:
+			RunLoop(double step, size_t latency);
+			~RunLoop();
+			double GetStep();
+			int GetMaxSteps();
+			void SetMaxSteps(int maxSteps);
+			size_t GetLatency();
+			void SetLatency(size_t latency);
+			uint64_t GetTick();
+			double GetTime();
+			float GetAlpha(double stateTime);
+			void Start();
+			void Stop();
+			bool IsRunning();
+			void Run(wnd::Window* window);
+			void (*OnSimulate)(RunLoop* loop, double step);
+			void (*OnRender)(RunLoop* loop, wnd::Window* window);
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,218 @@
+#ifndef AGE_POOL_HPP
+#define AGE_POOL_HPP
+
+#include "agedef.hpp"
+#include "agerp.hpp"
+
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#define AGE_HANDLE_INDEX_BITS 20
+#define AGE_HANDLE_INDEX_MASK ((1u << AGE_HANDLE_INDEX_BITS) - 1)
+#define AGE_HANDLE_GENERATION_MASK ((1u << (32 - AGE_HANDLE_INDEX_BITS)) - 1)
+#define AGE_MAX_MESH_VBOS 16
+
+namespace age
+{
+	namespace rp
+	{
+		// 32-bit handle: slot index in the low bits, slot generation in the high bits. Zero is the null handle.
+		template <typename T>
+		struct Handle
+		{
+			uint32_t value;
+			uint32_t GetIndex() const { return this->value & AGE_HANDLE_INDEX_MASK; }
+			uint32_t GetGeneration() const { return this->value >> AGE_HANDLE_INDEX_BITS; }
+			bool IsNull() const { return this->value == 0; }
+			bool operator==(const Handle& other) const { return this->value == other.value; }
+			bool operator!=(const Handle& other) const { return this->value != other.value; }
+		};
+
+		typedef Handle<GLBuffer> BufferHandle;
+		typedef Handle<Texture> TextureHandle;
+		typedef Handle<Mesh> MeshHandle;
+		typedef Handle<Shader> ShaderHandle;
+
+		// Element count kept next to the GL name in a pool: index count for meshes, array length for buffers.
+		template <typename T> inline GLsizei GetElementCount(T*) { return 0; }
+		template <> inline GLsizei GetElementCount<Mesh>(Mesh* item) { return (GLsizei)(item->GetCount()); }
+		template <> inline GLsizei GetElementCount<GLBuffer>(GLBuffer* item) { return (GLsizei)(item->GetSize().array); }
+
+		class AGE_API LinearArena
+		{
+		private:
+			unsigned char* memory;
+			size_t capacity, offset;
+		public:
+			LinearArena(size_t capacity);
+			~LinearArena();
+			LinearArena(const LinearArena&) = delete;
+			LinearArena& operator=(const LinearArena&) = delete;
+			void* Allocate(size_t size, size_t alignment);
+			template <typename T> T* Allocate(size_t count) { return (T*)this->Allocate(count * sizeof(T), alignof(T)); }
+			void Reset();
+			size_t GetCapacity();
+			size_t GetUsed();
+		};
+
+		// Slot map with a fixed capacity: objects live in one contiguous block, the GL names, element counts
+		// and generations are kept in their own arrays for the draw loop, and destroyed slots are only reused once the GPU frame
+		// that last saw them has completed.
+		template <typename T>
+		class Pool
+		{
+		private:
+			enum : unsigned char { FREE, LIVE, PENDING };
+			struct Pending
+			{
+				uint32_t index;
+				uint64_t frame;
+			};
+			typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Storage;
+			uint32_t capacity, count;
+			Storage* items;
+			GLuint* ids;
+			GLsizei* counts;
+			uint32_t* generations;
+			unsigned char* states;
+			uint32_t* freeList;
+			uint32_t freeCount;
+			Pending* pending;
+			uint32_t pendingHead, pendingCount;
+			T* At(uint32_t index) { return reinterpret_cast<T*>(&this->items[index]); }
+			bool Owns(Handle<T> handle)
+			{
+				uint32_t index = handle.GetIndex();
+				return !handle.IsNull() && index < this->capacity && this->states[index] == LIVE && this->generations[index] == handle.GetGeneration();
+			}
+			void Release(uint32_t index)
+			{
+				this->At(index)->~T();
+				this->states[index] = FREE;
+				this->freeList[this->freeCount++] = index;
+			}
+		public:
+			Pool(uint32_t capacity)
+			{
+				this->capacity = capacity < AGE_HANDLE_INDEX_MASK ? capacity : AGE_HANDLE_INDEX_MASK;
+				this->count = 0;
+				this->items = new Storage[this->capacity];
+				this->ids = new GLuint[this->capacity];
+				this->counts = new GLsizei[this->capacity];
+				this->generations = new uint32_t[this->capacity];
+				this->states = new unsigned char[this->capacity];
+				this->freeList = new uint32_t[this->capacity];
+				this->pending = new Pending[this->capacity];
+				this->freeCount = this->capacity;
+				this->pendingHead = 0;
+				this->pendingCount = 0;
+				for (uint32_t i = 0; i < this->capacity; i++)
+				{
+					this->ids[i] = 0;
+					this->counts[i] = 0;
+					this->generations[i] = 1;
+					this->states[i] = FREE;
+					this->freeList[i] = this->capacity - 1 - i;
+				}
+			}
+			~Pool()
+			{
+				for (uint32_t i = 0; i < this->capacity; i++)
+				{
+					if (this->states[i] != FREE) this->At(i)->~T();
+				}
+				delete[] this->items;
+				delete[] this->ids;
+				delete[] this->counts;
+				delete[] this->generations;
+				delete[] this->states;
+				delete[] this->freeList;
+				delete[] this->pending;
+			}
+			Pool(const Pool&) = delete;
+			Pool& operator=(const Pool&) = delete;
+			template <typename... Args>
+			Handle<T> Create(Args&&... args)
+			{
+				Handle<T> handle = { 0 };
+				if (this->freeCount == 0) return handle;
+				uint32_t index = this->freeList[--this->freeCount];
+				T* item = new (&this->items[index]) T(std::forward<Args>(args)...);
+				this->ids[index] = item->GetId();
+				this->counts[index] = rp::GetElementCount(item);
+				this->states[index] = LIVE;
+				this->count++;
+				handle.value = (this->generations[index] << AGE_HANDLE_INDEX_BITS) | index;
+				return handle;
+			}
+			void Destroy(Handle<T> handle, uint64_t frame)
+			{
+				if (!(this->Owns(handle))) return;
+				uint32_t index = handle.GetIndex();
+				this->generations[index] = (this->generations[index] + 1) & AGE_HANDLE_GENERATION_MASK;
+				if (this->generations[index] == 0) this->generations[index] = 1;
+				this->ids[index] = 0;
+				this->counts[index] = 0;
+				this->states[index] = PENDING;
+				this->count--;
+				Pending& entry = this->pending[(this->pendingHead + this->pendingCount++) % this->capacity];
+				entry.index = index;
+				entry.frame = frame;
+			}
+			void Collect(uint64_t completedFrame)
+			{
+				while (this->pendingCount > 0 && this->pending[this->pendingHead].frame < completedFrame)
+				{
+					this->Release(this->pending[this->pendingHead].index);
+					this->pendingHead = (this->pendingHead + 1) % this->capacity;
+					this->pendingCount--;
+				}
+			}
+			bool IsValid(Handle<T> handle) { return this->Owns(handle); }
+			T* Get(Handle<T> handle) { return this->Owns(handle) ? this->At(handle.GetIndex()) : NULL; }
+			GLuint GetId(Handle<T> handle) { return this->Owns(handle) ? this->ids[handle.GetIndex()] : 0; }
+			GLsizei GetElementCount(Handle<T> handle) { return this->Owns(handle) ? this->counts[handle.GetIndex()] : 0; }
+			uint32_t GetCapacity() { return this->capacity; }
+			uint32_t GetCount() { return this->count; }
+			uint32_t GetPendingCount() { return this->pendingCount; }
+		};
+
+		class AGE_API ResourcePools
+		{
+		private:
+			FrameFence fence;
+			LinearArena arena;
+			Pool<GLBuffer> buffers;
+			Pool<Texture> textures;
+			Pool<Mesh> meshes;
+			Pool<Shader> shaders;
+		public:
+			ResourcePools(uint32_t capacity, size_t arenaSize, size_t framesInFlight);
+			~ResourcePools();
+			void BeginFrame();
+			void EndFrame();
+			uint64_t GetFrame();
+			LinearArena* GetArena();
+			BufferHandle CreateBuffer(BufSize size, GLenum type, const void* data, GLbitfield flags);
+			TextureHandle CreateTexture(GLenum type, int width, int height, int depth, int levels, GLenum format, GLenum filter, GLenum wrapMode);
+			TextureHandle CreateCubeMap(int width, int height, GLenum format, GLenum filter, GLenum wrapMode);
+			MeshHandle CreateMesh(size_t vboCount, const BufferHandle* vbos, size_t indexCount, const uint* indices);
+			ShaderHandle CreateShader(size_t count, const GLuint* shaders);
+			GLBuffer* Get(BufferHandle handle);
+			Texture* Get(TextureHandle handle);
+			Mesh* Get(MeshHandle handle);
+			Shader* Get(ShaderHandle handle);
+			void Destroy(BufferHandle handle);
+			void Destroy(TextureHandle handle);
+			void Destroy(MeshHandle handle);
+			void Destroy(ShaderHandle handle);
+			Pool<GLBuffer>* GetBuffers();
+			Pool<Texture>* GetTextures();
+			Pool<Mesh>* GetMeshes();
+			Pool<Shader>* GetShaders();
+		};
+	}
+}
+
+#endif
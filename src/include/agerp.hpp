@@ -3,6 +3,12 @@
 
 #include "agedef.hpp"
 
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#define AGE_MAX_SHADER_STAGES 6
+
 namespace age
 {
 	namespace rp
@@ -44,6 +50,8 @@ namespace age
 		public:
 			Mesh(size_t vboCount, GLBuffer* vbos[], size_t indexCount, const uint* indices);
 			~Mesh();
+			GLuint GetId();
+			size_t GetCount();
 			void SetVBO(GLuint binding, GLBuffer* vbo);
 			void Draw();
 		};
@@ -54,15 +62,68 @@ namespace age
 			size_t count;
 			GLuint program;
 			GLuint* shaders;
+			GLuint inlineShaders[AGE_MAX_SHADER_STAGES];
 		public:
 			Shader(size_t count, const GLuint* shaders);
 			~Shader();
+			GLuint GetId();
+			bool IsLinked();
 			void Bind();
 			void Unbind();
 			GLint GetUniformLocation(std::string name);
 			static GLuint CreateShader(GLenum type, std::string src);
 			static GLuint CreateShader(GLenum type, std::istream& input);
 			static void DeleteShader(GLuint detachedShader);
+			static void BindProgram(GLuint program);
+		};
+
+		typedef std::map<std::string, std::string> ShaderDefines;
+
+		class AGE_API ShaderPreprocessor
+		{
+		private:
+			std::vector<std::string> directories;
+			std::map<std::string, std::string> sources;
+			bool Resolve(std::string name, std::string& src);
+			bool Expand(std::string src, int file, std::vector<std::string>& files, std::string& out);
+		public:
+			void AddDirectory(std::string path);
+			void AddSource(std::string name, std::string src);
+			bool Process(std::string src, const ShaderDefines& defines, std::string& out);
+			bool Process(std::string src, const ShaderDefines& defines, std::string& out, std::vector<std::string>& files);
+		};
+
+		struct ShaderStats
+		{
+			size_t programs, variants, failures, hits, misses, maxVariants;
+		};
+
+		class AGE_API ShaderCache
+		{
+		private:
+			struct Program
+			{
+				std::vector<GLenum> types;
+				std::vector<std::string> sources;
+				std::vector<std::string> keys;
+			};
+			ShaderPreprocessor* preprocessor;
+			std::map<std::string, Program> programs;
+			std::unordered_map<std::string, Shader*> variants;
+			std::unordered_map<std::string, std::string> logs;
+			size_t failures, hits, misses;
+			Shader* Compile(Program& program, const ShaderDefines& defines, std::string& log);
+			void Evict(Program& program);
+		public:
+			ShaderCache(ShaderPreprocessor* preprocessor);
+			~ShaderCache();
+			void AddProgram(std::string name, size_t count, const GLenum* types, const std::string* sources);
+			Shader* GetVariant(std::string name, const ShaderDefines& defines);
+			size_t GetVariantCount(std::string name);
+			std::string GetLog(std::string name, const ShaderDefines& defines);
+			ShaderStats GetStats();
+			void Clear();
+			static std::string GetKey(std::string name, const ShaderDefines& defines);
 		};
 
 		class AGE_API Texture
@@ -99,6 +160,24 @@ namespace age
 			void BindImage(uint index, int level, GLboolean layered, int layer, GLenum access);
 			void UnbindImage(uint index, int level, GLboolean layered, int layer, GLenum access);
 		};
+
+		class AGE_API FrameFence
+		{
+		private:
+			size_t count;
+			GLsync* fences;
+			uint64_t frame;
+			uint64_t completed;
+			void Release();
+		public:
+			FrameFence(size_t count);
+			~FrameFence();
+			size_t GetCount();
+			uint64_t GetFrame();
+			uint64_t GetCompletedFrame();
+			void Signal();
+			bool Wait(size_t framesInFlight, GLuint64 timeout);
+		};
 	}
 }
 